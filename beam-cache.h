@@ -0,0 +1,163 @@
+/**
+* @file beam-cache.h
+* @brief ideal beamforming helper with a per-link beam cache
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef BEAM_CACHE
+#define BEAM_CACHE
+
+#include "ns3/double.h"
+#include "ns3/ideal-beamforming-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/nr-spectrum-phy.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace ns3
+{
+
+/**
+ * @brief IdealBeamformingHelper that reuses beams while a link does not move
+ *
+ * The relative position of the UE seen from the gNB (distance, azimuth and
+ * inclination) and the bearing of both antenna arrays are quantized on a
+ * grid of DistanceStep meters and AngleStep degrees. The beamforming vectors
+ * of a gNB/UE pair are recomputed only when the pair leaves its grid cell,
+ * so the periodic beam update costs scale with movement instead of
+ * simulated time x pairs.
+ */
+class CachedIdealBeamformingHelper : public IdealBeamformingHelper
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::CachedIdealBeamformingHelper")
+                .SetParent<IdealBeamformingHelper>()
+                .AddConstructor<CachedIdealBeamformingHelper>()
+                .AddAttribute("DistanceStep",
+                              "Distance quantization step of the cache grid (m), > 0",
+                              DoubleValue(10.0),
+                              MakeDoubleAccessor(&CachedIdealBeamformingHelper::m_distanceStep),
+                              MakeDoubleChecker<double>(std::numeric_limits<double>::min()))
+                .AddAttribute("AngleStep",
+                              "Angle quantization step of the cache grid (degrees), > 0",
+                              DoubleValue(2.0),
+                              MakeDoubleAccessor(&CachedIdealBeamformingHelper::m_angleStep),
+                              MakeDoubleChecker<double>(std::numeric_limits<double>::min()));
+        return tid;
+    }
+
+    uint64_t GetHits() const
+    {
+        return m_hits;
+    }
+
+    uint64_t GetMisses() const
+    {
+        return m_misses;
+    }
+
+    double GetHitRate() const
+    {
+        uint64_t total = m_hits + m_misses;
+        return (total > 0) ? static_cast<double>(m_hits) / total : 0.0;
+    }
+
+    std::string GetStatsStr() const
+    {
+        std::stringstream ss;
+        ss << "Beam cache: " << m_hits << " hits, " << m_misses << " misses, hit rate "
+           << GetHitRate() * 100.0 << "%";
+        return ss.str();
+    }
+
+  protected:
+    BeamformingVectorPair GetBeamformingVectors(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override
+    {
+        Cell cell = GetCell(gnbSpectrumPhy, ueSpectrumPhy);
+        auto key = std::make_pair(gnbSpectrumPhy, ueSpectrumPhy);
+        auto it = m_cache.find(key);
+        if (it != m_cache.end() && it->second.first == cell)
+        {
+            m_hits++;
+            return it->second.second;
+        }
+        m_misses++;
+        BeamformingVectorPair vectors =
+            IdealBeamformingHelper::GetBeamformingVectors(gnbSpectrumPhy, ueSpectrumPhy);
+        m_cache[key] = std::make_pair(cell, vectors);
+        return vectors;
+    }
+
+  private:
+    using Cell = std::array<int64_t, 5>;
+
+    static double GetBearing(const Ptr<NrSpectrumPhy>& phy)
+    {
+        DoubleValue bearing;
+        auto antenna = phy->GetAntenna();
+        if (antenna)
+        {
+            antenna->GetAttributeFailSafe("BearingAngle", bearing);
+        }
+        return bearing.Get();
+    }
+
+    static int64_t Quantize(double value, double step)
+    {
+        return static_cast<int64_t>(std::floor(value / step));
+    }
+
+    Cell GetCell(const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                 const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
+    {
+        Vector d = ueSpectrumPhy->GetMobility()->GetPosition() -
+                   gnbSpectrumPhy->GetMobility()->GetPosition();
+        double distance = d.GetLength();
+        double azimuth = std::atan2(d.y, d.x) * 180.0 / M_PI;
+        double inclination = (distance > 0.0) ? std::acos(d.z / distance) * 180.0 / M_PI : 0.0;
+        double angleStepRad = m_angleStep * M_PI / 180.0;
+        return {Quantize(distance, m_distanceStep),
+                Quantize(azimuth, m_angleStep),
+                Quantize(inclination, m_angleStep),
+                Quantize(GetBearing(gnbSpectrumPhy), angleStepRad),
+                Quantize(GetBearing(ueSpectrumPhy), angleStepRad)};
+    }
+
+    double m_distanceStep{10.0};
+    double m_angleStep{2.0};
+    mutable std::map<std::pair<Ptr<NrSpectrumPhy>, Ptr<NrSpectrumPhy>>,
+                     std::pair<Cell, BeamformingVectorPair>>
+        m_cache;
+    mutable uint64_t m_hits{0};
+    mutable uint64_t m_misses{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(CachedIdealBeamformingHelper);
+
+} // namespace ns3
+
+/**
+ * @brief beam cache config
+ *
+ * @param enabled use CachedIdealBeamformingHelper
+ * @param distance_step grid step (m)
+ * @param angle_step grid step (degrees)
+ */
+struct beam_cache_config {
+    bool enabled = false;
+    double distance_step = 10.0;
+    double angle_step = 2.0;
+};
+
+#endif
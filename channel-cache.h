@@ -0,0 +1,448 @@
+/**
+* @file channel-cache.h
+* @brief on-disk channel realization cache
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef CHANNEL_CACHE
+#define CHANNEL_CACHE
+
+#include "ns3/mobility-model.h"
+#include "ns3/node.h"
+#include "ns3/phased-array-model.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/three-gpp-channel-model.h"
+
+#include <array>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+/**
+ * @brief FNV-1a hash, chainable through h
+ */
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief identity of a trace file: its size and a hash of its first MiB
+ *
+ * Hashing the whole file would cost as much as reading a multi-GB trace.
+ */
+uint64_t get_file_hash(std::string_view file) {
+    std::ifstream input(file.data(), std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    input.read(buffer.data(), buffer.size());
+    uint64_t h = fnv1a(buffer.data(), input.gcount());
+    struct stat st;
+    uint64_t size = (stat(file.data(), &st) == 0) ? st.st_size : 0;
+    return fnv1a(&size, sizeof(size), h);
+}
+
+namespace ns3
+{
+
+/**
+ * @brief ThreeGppChannelModel that records and replays channel realizations
+ *
+ * On the first run (no cache file) every channel realization the 3GPP model
+ * generates (periodic updates, LOS/NLOS changes, ...) is recorded with its
+ * parameters, keyed by link and generation time. When the file exists it is
+ * memory-mapped and each link is served the latest recorded realization
+ * generated at or before Now; links with no such record fall back to the 3GPP
+ * model. Replay reproduces the recorded run when the channels are requested
+ * at the same times, e.g. an application-only sweep with the same seed, run,
+ * trace and band; the file name must therefore be derived from those (see
+ * get_file_hash()).
+ */
+class CachedThreeGppChannelModel : public ThreeGppChannelModel
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::CachedThreeGppChannelModel")
+                                .SetParent<ThreeGppChannelModel>()
+                                .AddConstructor<CachedThreeGppChannelModel>()
+                                .AddAttribute("CacheFile",
+                                              "File used to record/replay the channels",
+                                              StringValue(""),
+                                              MakeStringAccessor(&CachedThreeGppChannelModel::Open),
+                                              MakeStringChecker());
+        return tid;
+    }
+
+    ~CachedThreeGppChannelModel() override
+    {
+        Close();
+    }
+
+    Ptr<const ChannelMatrix> GetChannel(Ptr<const MobilityModel> aMob,
+                                        Ptr<const MobilityModel> bMob,
+                                        Ptr<const PhasedArrayModel> aAntenna,
+                                        Ptr<const PhasedArrayModel> bAntenna) override
+    {
+        LinkKey link = GetLinkKey(aMob, bMob, aAntenna, bAntenna);
+        NodePair nodes{link[0], link[1]};
+        if (m_data != nullptr)
+        {
+            auto record = FindRecord(link);
+            if (record != nullptr)
+            {
+                m_hits++;
+                auto it = m_replayed.find(link);
+                if (it == m_replayed.end() || std::get<0>(it->second) != record->first)
+                {
+                    it = m_replayed.insert_or_assign(link, Replay(record->second, record->first)).first;
+                }
+                m_replayedParams[nodes] = std::get<2>(it->second);
+                return std::get<1>(it->second);
+            }
+            m_replayed.erase(link);
+            m_replayedParams.erase(nodes);
+        }
+        m_misses++;
+        Ptr<const ChannelMatrix> channel =
+            ThreeGppChannelModel::GetChannel(aMob, bMob, aAntenna, bAntenna);
+        if (m_output.is_open())
+        {
+            // the base model returns the same matrix until it regenerates it
+            auto& last = m_recorded[link];
+            if (last != channel || last->m_generatedTime != channel->m_generatedTime)
+            {
+                last = channel;
+                Record(link, channel, ThreeGppChannelModel::GetParams(aMob, bMob));
+            }
+        }
+        return channel;
+    }
+
+    Ptr<const ChannelParams> GetParams(Ptr<const MobilityModel> aMob,
+                                       Ptr<const MobilityModel> bMob) const override
+    {
+        uint32_t a = aMob->GetObject<Node>()->GetId();
+        uint32_t b = bMob->GetObject<Node>()->GetId();
+        auto it = m_replayedParams.find(NodePair{std::min(a, b), std::max(a, b)});
+        if (it != m_replayedParams.end())
+        {
+            return it->second;
+        }
+        return ThreeGppChannelModel::GetParams(aMob, bMob);
+    }
+
+    bool IsReplaying() const
+    {
+        return m_data != nullptr;
+    }
+
+    std::string GetStatsStr() const
+    {
+        std::stringstream ss;
+        ss << "Channel cache (" << (IsReplaying() ? "replay" : "record") << "): " << m_hits
+           << " replayed, " << m_misses << " generated";
+        return ss.str();
+    }
+
+    /**
+     * @brief unmaps the cache, or moves a recorded cache to its final name
+     */
+    void Close()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(m_data, m_size);
+            m_data = nullptr;
+            m_index.clear();
+            m_replayed.clear();
+            m_replayedParams.clear();
+        }
+        if (m_output.is_open())
+        {
+            m_output.close();
+            std::rename(GetTemporaryFile().c_str(), m_file.c_str());
+            m_recorded.clear();
+        }
+    }
+
+  private:
+    /// node ids and antenna ids of a link, ordered by node id
+    using LinkKey = std::array<uint32_t, 4>;
+    using NodePair = std::array<uint32_t, 2>;
+    /// generation time (TimeStep), channel, params
+    using Replayed = std::tuple<int64_t, Ptr<const ChannelMatrix>, Ptr<const ChannelParams>>;
+    /// generation time (TimeStep) -> record offset, per link
+    using Records = std::map<int64_t, size_t>;
+
+    static constexpr char MAGIC[8] = {'N', 'R', 'C', 'H', 'C', 'A', 'C', '2'};
+
+    static LinkKey GetLinkKey(Ptr<const MobilityModel> aMob,
+                              Ptr<const MobilityModel> bMob,
+                              Ptr<const PhasedArrayModel> aAntenna,
+                              Ptr<const PhasedArrayModel> bAntenna)
+    {
+        uint32_t a = aMob->GetObject<Node>()->GetId();
+        uint32_t b = bMob->GetObject<Node>()->GetId();
+        uint32_t aa = aAntenna ? aAntenna->GetId() : 0;
+        uint32_t ba = bAntenna ? bAntenna->GetId() : 0;
+        return (a < b) ? LinkKey{a, b, aa, ba} : LinkKey{b, a, ba, aa};
+    }
+
+    /// latest record of link generated at or before Now, nullptr if none
+    const Records::value_type* FindRecord(const LinkKey& link) const
+    {
+        auto records = m_index.find(link);
+        if (records == m_index.end())
+        {
+            return nullptr;
+        }
+        auto it = records->second.upper_bound(Simulator::Now().GetInteger());
+        if (it == records->second.begin())
+        {
+            return nullptr;
+        }
+        return &*std::prev(it);
+    }
+
+    /// runs recording the same key in parallel must not share a file
+    std::string GetTemporaryFile() const
+    {
+        return m_file + "." + std::to_string(getpid()) + ".tmp";
+    }
+
+    void Open(std::string file)
+    {
+        Close();
+        m_file = file;
+        if (m_file.empty())
+        {
+            return;
+        }
+        int fd = open(m_file.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            m_size = st.st_size;
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            m_data = (data == MAP_FAILED) ? nullptr : static_cast<char*>(data);
+            if (m_data != nullptr && BuildIndex())
+            {
+                return;
+            }
+            NS_LOG_UNCOND("Ignoring invalid channel cache " << m_file);
+            Close();
+        }
+        else if (fd >= 0)
+        {
+            close(fd);
+        }
+        m_output.open(GetTemporaryFile(), std::ios::binary | std::ios::trunc);
+        m_output.write(MAGIC, sizeof(MAGIC));
+    }
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        m_output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void WriteVector(const std::vector<T>& values)
+    {
+        Write<uint64_t>(values.size());
+        m_output.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+    }
+
+    void WritePair(const std::pair<uint32_t, uint32_t>& value)
+    {
+        Write(value.first);
+        Write(value.second);
+    }
+
+    std::pair<uint32_t, uint32_t> ReadPair(size_t& offset) const
+    {
+        uint32_t first = Read<uint32_t>(offset);
+        return std::make_pair(first, Read<uint32_t>(offset));
+    }
+
+    template <typename T>
+    T Read(size_t& offset) const
+    {
+        T value;
+        std::memcpy(&value, m_data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> ReadVector(size_t& offset) const
+    {
+        std::vector<T> values(Read<uint64_t>(offset));
+        std::memcpy(values.data(), m_data + offset, sizeof(T) * values.size());
+        offset += sizeof(T) * values.size();
+        return values;
+    }
+
+    /**
+     * Record layout: link, generation time, record size, channel matrix,
+     * channel params.
+     */
+    void Record(const LinkKey& link,
+                Ptr<const ChannelMatrix> channel,
+                Ptr<const ChannelParams> params)
+    {
+        std::ostream::pos_type start = m_output.tellp();
+        Write(link);
+        Write(channel->m_generatedTime.GetInteger());
+        Write<uint64_t>(0); // record size, patched below
+        const Complex3DVector& h = channel->m_channel;
+        Write<uint64_t>(h.GetNumRows());
+        Write<uint64_t>(h.GetNumCols());
+        Write<uint64_t>(h.GetNumPages());
+        for (size_t i = 0; i < h.GetSize(); i++)
+        {
+            Write(h[i]);
+        }
+        Write(channel->m_generatedTime.GetInteger());
+        WritePair(channel->m_antennaPair);
+        WritePair(channel->m_nodeIds);
+        Write(params->m_generatedTime.GetInteger());
+        WritePair(params->m_nodeIds);
+        Write(params->m_losCondition);
+        Write(params->m_o2iCondition);
+        WriteVector(params->m_delay);
+        Write<uint64_t>(params->m_angle.size());
+        for (const auto& angle : params->m_angle)
+        {
+            WriteVector(angle);
+        }
+        Write<uint64_t>(params->m_cachedAngleSincos.size());
+        for (const auto& sincos : params->m_cachedAngleSincos)
+        {
+            Write<uint64_t>(sincos.size());
+            for (const auto& [sin, cos] : sincos)
+            {
+                Write(sin);
+                Write(cos);
+            }
+        }
+        WriteVector(params->m_alpha);
+        WriteVector(params->m_D);
+        std::ostream::pos_type end = m_output.tellp();
+        m_output.seekp(start + std::streamoff(sizeof(LinkKey) + sizeof(int64_t)));
+        Write<uint64_t>(end - start);
+        m_output.seekp(end);
+    }
+
+    bool BuildIndex()
+    {
+        if (m_size < sizeof(MAGIC) || std::memcmp(m_data, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            return false;
+        }
+        size_t offset = sizeof(MAGIC);
+        const size_t header = sizeof(LinkKey) + sizeof(int64_t) + sizeof(uint64_t);
+        while (offset + header <= m_size)
+        {
+            size_t record = offset;
+            LinkKey link = Read<LinkKey>(offset);
+            int64_t generated = Read<int64_t>(offset);
+            uint64_t size = Read<uint64_t>(offset);
+            if (size < header || record + size > m_size)
+            {
+                return false;
+            }
+            m_index[link][generated] = offset;
+            offset = record + size;
+        }
+        return true;
+    }
+
+    Replayed Replay(size_t offset, int64_t generated) const
+    {
+        Ptr<ChannelMatrix> channel = Create<ChannelMatrix>();
+        auto rows = Read<uint64_t>(offset);
+        auto cols = Read<uint64_t>(offset);
+        auto pages = Read<uint64_t>(offset);
+        channel->m_channel = Complex3DVector(rows, cols, pages);
+        for (size_t i = 0; i < channel->m_channel.GetSize(); i++)
+        {
+            channel->m_channel[i] = Read<std::complex<double>>(offset);
+        }
+        channel->m_generatedTime = TimeStep(Read<int64_t>(offset));
+        channel->m_antennaPair = ReadPair(offset);
+        channel->m_nodeIds = ReadPair(offset);
+
+        Ptr<ChannelParams> params = Create<ChannelParams>();
+        params->m_generatedTime = TimeStep(Read<int64_t>(offset));
+        params->m_nodeIds = ReadPair(offset);
+        params->m_losCondition = Read<ChannelCondition::LosConditionValue>(offset);
+        params->m_o2iCondition = Read<ChannelCondition::O2iConditionValue>(offset);
+        params->m_delay = ReadVector<double>(offset);
+        params->m_angle.resize(Read<uint64_t>(offset));
+        for (auto& angle : params->m_angle)
+        {
+            angle = ReadVector<double>(offset);
+        }
+        params->m_cachedAngleSincos.resize(Read<uint64_t>(offset));
+        for (auto& sincos : params->m_cachedAngleSincos)
+        {
+            sincos.resize(Read<uint64_t>(offset));
+            for (auto& [sin, cos] : sincos)
+            {
+                sin = Read<double>(offset);
+                cos = Read<double>(offset);
+            }
+        }
+        params->m_alpha = ReadVector<double>(offset);
+        params->m_D = ReadVector<double>(offset);
+        return Replayed{generated, channel, params};
+    }
+
+    std::string m_file;
+    char* m_data{nullptr};
+    size_t m_size{0};
+    std::map<LinkKey, Records> m_index;
+    std::map<LinkKey, Replayed> m_replayed;
+    std::map<NodePair, Ptr<const ChannelParams>> m_replayedParams;
+    std::ofstream m_output;
+    /// last realization recorded per link
+    std::map<LinkKey, Ptr<const ChannelMatrix>> m_recorded;
+    uint64_t m_hits{0};
+    uint64_t m_misses{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(CachedThreeGppChannelModel);
+
+} // namespace ns3
+
+/**
+ * @brief channel cache config
+ *
+ * @param enabled record/replay the channels of every bandwidth part
+ * @param dir directory of the cache files
+ */
+struct channel_cache_config {
+    bool enabled = false;
+    std::string dir = "./";
+};
+
+#endif
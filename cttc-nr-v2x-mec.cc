@@ -4,7 +4,13 @@
 // Author: Sérgio Vieira - sergio.vieira@ifce.edu.br
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include "beam-cache.h"
+#include "channel-cache.h"
+#include "fcd-utils.h"
+#include "mec-utils.h"
 #include "mob-utils.h"
+#include "replication-utils.h"
+#include "sl-zone-utils.h"
 
 #include "ns3/antenna-module.h"
 #include "ns3/applications-module.h"
@@ -32,6 +38,8 @@
 #include "ns3/udp-header.h"
 
 #include <filesystem>
+#include <map>
+#include <memory>
 #include <vector>
 
 using namespace ns3;
@@ -70,11 +78,75 @@ create_gnb_nodes(const NodeMap& map)
     return gnbNodes;
 }
 
+/**
+ * @brief streaming state of a SUMO FCD mobility trace
+ *
+ * Holds the timestep that will be installed next, so only one timestep is
+ * kept in memory regardless of the trace size.
+ */
+struct fcd_mobility_state {
+    explicit fcd_mobility_state(std::string_view file)
+        : input(open_file(file)), reader(*input) {}
+    std::unique_ptr<std::istream> input;
+    fcd_reader reader;
+    double time = 0.0;
+    std::vector<fcd_position> positions;
+};
+
+void
+feed_fcd_waypoints(std::shared_ptr<fcd_mobility_state> state, NodeContainer ueNodes)
+{
+    // Install the pending timestep and read one ahead, so the waypoint
+    // mobility models always know their next position.
+    for (const fcd_position& p: state->positions) {
+        if (p.node_id >= ueNodes.GetN()) continue;
+        ueNodes.Get(p.node_id)->GetObject<WaypointMobilityModel>()->AddWaypoint(
+            Waypoint(Seconds(state->time), Vector(p.x, p.y, p.z)));
+    }
+    Time installed = Seconds(state->time);
+    if (state->reader.next_timestep(state->time, state->positions)) {
+        Simulator::Schedule(installed - Simulator::Now(), &feed_fcd_waypoints, state, ueNodes);
+    } else {
+        state->input.reset();
+    }
+}
+
+void
+install_fcd_mobility(NodeContainer& ueNodes, const mob_info& info, std::string& full_filename)
+{
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::WaypointMobilityModel");
+    mobility.Install(ueNodes);
+    // Like the NS2 path, a vehicle waits at its first position until its
+    // first waypoint instead of at the origin.
+    for (const node& n: info.first_positions) {
+        if (n.id >= ueNodes.GetN()) continue;
+        ueNodes.Get(n.id)->GetObject<MobilityModel>()->SetPosition(Vector(n.x, n.y, n.z));
+    }
+    auto state = std::make_shared<fcd_mobility_state>(full_filename);
+    if (state->reader.next_timestep(state->time, state->positions)) {
+        feed_fcd_waypoints(state, ueNodes);
+    }
+}
+
 ns3::NodeContainer
 create_ue_nodes(mob_info& info, std::string& full_filename)
 {
     ns3::NodeContainer ueNodes;
     ueNodes.Create(info.nodes);
+    if (is_fcd_file(full_filename)) {
+        install_fcd_mobility(ueNodes, info, full_filename);
+        return ueNodes;
+    }
+    if (is_compressed_file(full_filename)) {
+        // Ns2MobilityHelper reads the trace once during Install, so it can
+        // read the decompressed data straight from the pipe.
+        decompressor d = start_decompressor(full_filename);
+        Ns2MobilityHelper ns2 = Ns2MobilityHelper(get_decompressor_path(d));
+        ns2.Install(ueNodes.Begin(), ueNodes.End());
+        stop_decompressor(d);
+        return ueNodes;
+    }
     Ns2MobilityHelper ns2 = Ns2MobilityHelper(full_filename);
     ns2.Install(ueNodes.Begin(), ueNodes.End());
     return ueNodes;
@@ -104,6 +176,11 @@ parse(ns3::CommandLine& cmd,
       std::string& gnbFile,
       std::string& outputDir,
       uint32_t& seed,
+      replication_config& replication,
+      beam_cache_config& beam_cache,
+      channel_cache_config& channel_cache,
+      mec_config& mec,
+      sidelink_zone_config& sl_zone,
       int argc,
       char* argv[])
 {
@@ -112,6 +189,34 @@ parse(ns3::CommandLine& cmd,
     cmd.AddValue("GNbPositions", "GNb's positions file", gnbFile);
     cmd.AddValue("outputDir", "Directory where to store simulation results", outputDir);
     cmd.AddValue("seed", "Seed value", seed);
+    cmd.AddValue("run", "Run number (RngSeedManager::SetRun)", replication.run);
+    cmd.AddValue("replications",
+        "Maximum number of replications, 0 runs a single simulation", replication.max_runs);
+    cmd.AddValue("minReplications", "Replications before checking the intervals", replication.min_runs);
+    cmd.AddValue("parallelReplications", "Replications executed in parallel", replication.parallel_runs);
+    cmd.AddValue("ciLevel", "Confidence level of the intervals", replication.ci_level);
+    cmd.AddValue("ciHalfWidth", "Target half-width relative to the mean", replication.ci_half_width);
+    cmd.AddValue("beamCache", "Reuse beams while a gNB/UE pair stays in the same grid cell", beam_cache.enabled);
+    cmd.AddValue("beamCacheDistanceStep", "Beam cache grid distance step (m)", beam_cache.distance_step);
+    cmd.AddValue("beamCacheAngleStep", "Beam cache grid angle step (degrees)", beam_cache.angle_step);
+    cmd.AddValue("channelCache", "Record/replay channel realizations on disk", channel_cache.enabled);
+    cmd.AddValue("channelCacheDir", "Directory of the channel cache files", channel_cache.dir);
+    cmd.AddValue("mec", "Attach vehicles to the gNBs and offload requests to a MEC host", mec.enabled);
+    cmd.AddValue("mecBackhaulDelay", "PGW to MEC host link delay (ms)", mec.backhaul_delay);
+    cmd.AddValue("mecServiceTime", "MEC compute time per request (ms)", mec.service_time);
+    cmd.AddValue("mecExponentialService", "Exponential instead of constant service time", mec.exponential_service);
+    cmd.AddValue("mecRequestSize", "Offload request size (bytes)", mec.request_size);
+    cmd.AddValue("mecResponseSize", "Offload response size (bytes)", mec.response_size);
+    cmd.AddValue("mecRequestInterval", "Time between requests of a vehicle (ms)", mec.request_interval);
+    cmd.AddValue("mecExponentialRequests", "Exponential instead of constant time between requests", mec.exponential_requests);
+    cmd.AddValue("mecClients", "Number of offloading vehicles, 0 for all", mec.clients);
+    cmd.AddValue("mecQueueingHalfWidth", "Target half-width of the mean MEC queueing delay (ms)", mec.queueing_half_width);
+    cmd.AddValue("slPools", "Number of zone-based sidelink resource pools", sl_zone.pools);
+    cmd.AddValue("slZoneLength", "Side of a sidelink zone (m)", sl_zone.zone_length);
+    cmd.AddValue("slZoneUpdatePeriod", "Period of the vehicle to pool reassignment (ms)", sl_zone.update_period);
+    cmd.AddValue("slTransmitters", "Number of vehicles sending groupcast traffic", sl_zone.transmitters);
+    cmd.AddValue("slCollisionRange", "Distance below which vehicles on the same subchannel-slot collide (m)", sl_zone.collision_range);
+    cmd.AddValue("slCollisionHalfWidth", "Target half-width of the sidelink collision ratio", sl_zone.collision_half_width);
     cmd.Parse(argc, argv);
 }
 
@@ -129,10 +234,21 @@ create_EPC_helper() {
     return epcHelper;
 }
 
+Ptr<IdealBeamformingHelper>
+create_beamforming_helper(const beam_cache_config& config) {
+    if (!config.enabled) {
+        return CreateObject<IdealBeamformingHelper>();
+    }
+    Ptr<CachedIdealBeamformingHelper> result = CreateObject<CachedIdealBeamformingHelper>();
+    result->SetAttribute("DistanceStep", DoubleValue(config.distance_step));
+    result->SetAttribute("AngleStep", DoubleValue(config.angle_step));
+    return result;
+}
+
 Ptr<NrHelper>
 create_5GNR_helper(Ptr<NrPointToPointEpcHelper> epcHelper,
+    Ptr<IdealBeamformingHelper> idealBeamformingHelper,
     double tx_power, uint8_t bwpIdForGbrMcptt = 0) {     
-    Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper>();
     Ptr<NrHelper> nrHelper = CreateObject<NrHelper>();
     nrHelper->SetBeamformingHelper(idealBeamformingHelper);
     nrHelper->SetEpcHelper(epcHelper);
@@ -184,6 +300,47 @@ create_operation_band() {
     return {5.89e9, 400e6, 1, BandwidthPartInfo::V2V_Urban};    
 }
 
+uint64_t
+get_channel_cache_key(uint32_t seed, uint32_t run,
+    const std::string& mobilityFile, const std::string& gnbFile,
+    const CcBwpCreator::SimpleOperationBandConf& conf) {
+    std::stringstream ss;
+    ss << seed << ' ' << run << ' '
+       << get_file_hash(mobilityFile) << ' ' << get_file_hash(gnbFile) << ' '
+       << conf.m_centralFrequency << ' ' << conf.m_channelBandwidth << ' '
+       << +conf.m_numCc << ' ' << static_cast<int>(conf.m_scenario);
+    std::string key = ss.str();
+    return fnv1a(key.data(), key.size());
+}
+
+std::vector<Ptr<CachedThreeGppChannelModel>>
+install_channel_cache(BandwidthPartInfoPtrVector& bwps,
+    const channel_cache_config& config, uint64_t key) {
+    // The model is replaced even without caching: its constructor draws
+    // automatic RNG stream indices, so creating it only with the cache would
+    // shift the streams of every later object and make cached and uncached
+    // runs incomparable. Without a CacheFile it is the plain 3GPP model.
+    std::vector<Ptr<CachedThreeGppChannelModel>> result;
+    if (config.enabled) std::filesystem::create_directories(config.dir);
+    for (size_t i = 0; i < bwps.size(); i++) {
+        Ptr<ThreeGppSpectrumPropagationLossModel> spectrum = bwps[i].get()->m_3gppChannel;
+        Ptr<ThreeGppChannelModel> channel = DynamicCast<ThreeGppChannelModel>(spectrum->GetChannelModel());
+        Ptr<CachedThreeGppChannelModel> cached = CreateObject<CachedThreeGppChannelModel>();
+        cached->SetAttribute("Frequency", DoubleValue(channel->GetFrequency()));
+        cached->SetAttribute("Scenario", StringValue(channel->GetScenario()));
+        cached->SetAttribute("ChannelConditionModel", PointerValue(channel->GetChannelConditionModel()));
+        spectrum->SetAttribute("ChannelModel", PointerValue(cached));
+        if (!config.enabled) continue;
+        std::stringstream file;
+        file << config.dir << "/channel-" << std::hex << key << std::dec << "-" << i << ".bin";
+        cached->SetAttribute("CacheFile", StringValue(file.str()));
+        std::cout << "Channel cache: " << file.str()
+                  << (cached->IsReplaying() ? " (replay)" : " (record)") << '\n';
+        result.push_back(cached);
+    }
+    return result;
+}
+
 OperationBandInfo 
 create_band(CcBwpCreator& creator,
     CcBwpCreator::SimpleOperationBandConf& conf) {
@@ -236,9 +393,15 @@ configure_sidelink_pool(LteRrcSap::SlResourcePoolIdNr& slResourcePoolIdNr,
 
 
 Ptr<NrSlCommResourcePoolFactory>
-create_preconfigured_sidelink_resource_pool_factory() {
+create_preconfigured_sidelink_resource_pool_factory(uint16_t pool = 0, uint16_t pools = 1,
+    uint16_t sidelink_slots = 1) {
     // Usar factory completamente padrão
-    return Create<NrSlCommResourcePoolFactory>();
+    auto result = Create<NrSlCommResourcePoolFactory>();
+    if (pools > 1) {
+        // Pools share the BWP in time, one slot of the bitmap each
+        result->SetSlTimeResources(create_pool_time_bitmap(pool, pools, sidelink_slots));
+    }
+    return result;
 }
 
 // Ptr<NrSlCommResourcePoolFactory>
@@ -315,6 +478,15 @@ create_sidelink_frequency_config(std::set<uint8_t>& bwpIdContainer,
     return result;
 }
 
+LteRrcSap::SlFreqConfigCommonNr 
+create_sidelink_frequency_config(std::map<uint8_t, LteRrcSap::SlBwpConfigCommonNr>& slBwpConfigs) {
+    LteRrcSap::SlFreqConfigCommonNr result;
+    for (const auto& [bwpId, slBwpConfigCommonNr] : slBwpConfigs) {
+        result.slBwpList[bwpId] = slBwpConfigCommonNr;
+    }
+    return result;
+}
+
 LteRrcSap::TddUlDlConfigCommon
 create_tdd_uplink_downlink_config(const std::string& pattern = "DL|DL|DL|F|UL|UL|UL|UL|UL|UL|") {
     LteRrcSap::TddUlDlConfigCommon result;
@@ -384,6 +556,39 @@ set_default_gatway(Ptr<NrPointToPointEpcHelper> epc_helper,
     }
 }
 
+Ipv4Address
+create_mec_host(Ptr<NrPointToPointEpcHelper> epc_helper,
+    NodeContainer& mec_nodes, const mec_config& config) {
+    mec_nodes.Create(1);
+    InternetStackHelper internet_stack_helper;
+    internet_stack_helper.Install(mec_nodes);
+    PointToPointHelper backhaul;
+    backhaul.SetDeviceAttribute("DataRate", DataRateValue(DataRate("100Gb/s")));
+    backhaul.SetDeviceAttribute("Mtu", UintegerValue(2500));
+    backhaul.SetChannelAttribute("Delay", TimeValue(MilliSeconds(config.backhaul_delay)));
+    NetDeviceContainer devices = backhaul.Install(epc_helper->GetPgwNode(), mec_nodes.Get(0));
+    Ipv4AddressHelper ipv4_address_helper;
+    ipv4_address_helper.SetBase("1.0.0.0", "255.0.0.0");
+    Ipv4InterfaceContainer interfaces = ipv4_address_helper.Assign(devices);
+    // route the UE subnet back through the PGW
+    Ipv4StaticRoutingHelper ipv4RoutingHelper;
+    Ptr<Ipv4StaticRouting> mecStaticRouting =
+        ipv4RoutingHelper.GetStaticRouting(mec_nodes.Get(0)->GetObject<Ipv4>());
+    mecStaticRouting->AddNetworkRouteTo(Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1);
+    return interfaces.GetAddress(1);
+}
+
+std::string
+get_service_time_str(const mec_config& config) {
+    std::stringstream ss;
+    if (config.exponential_service) {
+        ss << "ns3::ExponentialRandomVariable[Mean=" << config.service_time / 1000.0 << "]";
+    } else {
+        ss << "ns3::ConstantRandomVariable[Constant=" << config.service_time / 1000.0 << "]";
+    }
+    return ss.str();
+}
+
 void
 TxCallback(Ptr<CounterCalculator<uint32_t>> datac, 
 std::string path, 
@@ -397,6 +602,58 @@ uint32_t rxByteCounter = 0; //!< Global variable to count RX bytes
 uint32_t txByteCounter = 0; //!< Global variable to count TX bytes
 uint32_t rxPktCounter = 0;  //!< Global variable to count RX packets
 uint32_t txPktCounter = 0;  //!< Global variable to count TX packets
+uint32_t txSinkPoolPktCounter = 0; //!< Global variable to count TX packets sent in the sink's pool
+uint32_t sinkNodeId = 0;           //!< Global variable with the node id of the sink
+std::vector<double> rxLatencies; //!< Global variable to store RX latencies (ms)
+
+std::vector<pool_stats> poolStats;                //!< Global variable with per-pool statistics
+slot_occupancy slotOccupancy;                     //!< Global variable with the current slot occupancy
+std::unordered_map<uint32_t, uint16_t> nodePool;  //!< Global variable with the pool of each node
+std::unordered_map<uint64_t, Ptr<Node>> imsiNode; //!< Global variable with the node of each IMSI
+double collisionRange = 200.0;                    //!< Global variable with the collision range (m)
+std::vector<bool> sidelinkSlots;                  //!< Global variable with the sidelink slots of the TDD pattern
+double slotDurationMs = 1.0;                      //!< Global variable with the slot duration (ms)
+
+void
+assign_sidelink_pools(NetDeviceContainer ue_devices, sidelink_zone_config config, uint8_t bwpId)
+{
+    for (pool_stats& s : poolStats) {
+        s.vehicles = 0;
+    }
+    for (uint32_t u = 0; u < ue_devices.GetN(); ++u) {
+        Ptr<NrUeNetDevice> ueDevice = DynamicCast<NrUeNetDevice>(ue_devices.Get(u));
+        Vector position = ueDevice->GetNode()->GetObject<MobilityModel>()->GetPosition();
+        uint16_t pool = get_zone_pool(position.x, position.y, config);
+        imsiNode.try_emplace(ueDevice->GetImsi(), ueDevice->GetNode());
+        auto [it, inserted] = nodePool.try_emplace(ueDevice->GetNode()->GetId(), pool);
+        if (inserted || it->second != pool) {
+            if (!inserted) poolStats[pool].reassignments++;
+            it->second = pool;
+            ueDevice->GetMac(bwpId)->SetAttribute("ActivePoolId", UintegerValue(pool));
+        }
+        poolStats[pool].vehicles++;
+    }
+    if (config.pools > 1) {
+        Simulator::Schedule(MilliSeconds(config.update_period),
+            &assign_sidelink_pools, ue_devices, config, bwpId);
+    }
+}
+
+void
+NotifySlPscchScheduling(SlPscchUeMacStatParameters params)
+{
+    // Fired in the slot of the transmission, so its time identifies the slot.
+    // The slot, not the vehicle's current pool, gives the pool: grants
+    // reserved before a reassignment keep using the old pool's slots.
+    auto node = imsiNode.find(params.imsi);
+    if (poolStats.empty() || node == imsiNode.end()) return;
+    int64_t slot = std::llround(params.timeMs / slotDurationMs);
+    Vector position = node->second->GetObject<MobilityModel>()->GetPosition();
+    update_pool_stats(poolStats, slotOccupancy,
+        get_slot_pool(slot, sidelinkSlots, poolStats.size()), slot, params.imsi,
+        position.x, position.y, collisionRange,
+        params.slPsschSubChStart, params.slPsschSubChLength);
+}
 
 void
 ReceivePacket(Ptr<const Packet> packet, const Address& addr)
@@ -409,11 +666,29 @@ ReceivePacket(Ptr<const Packet> packet, const Address& addr)
 }
 
 void
-TransmitPacket(Ptr<const Packet> packet)
+ReceivePacketWithHeader(Ptr<const Packet> packet, const Address& from,
+    const Address& to, const SeqTsSizeHeader& header)
+{
+    rxLatencies.push_back((Simulator::Now() - header.GetTs()).GetSeconds() * 1000.0);
+}
+
+uint16_t
+get_node_pool(uint32_t nodeId)
+{
+    auto it = nodePool.find(nodeId);
+    return (it != nodePool.end()) ? it->second : 0;
+}
+
+void
+TransmitPacket(uint32_t nodeId, Ptr<const Packet> packet)
 {
     std::cout << "Sent Packet of size " << packet->GetSize() << '\n';
     txByteCounter += packet->GetSize();
     txPktCounter++;
+    // The sink only receives in its own pool, so only those packets count for the PDR
+    if (get_node_pool(nodeId) == get_node_pool(sinkNodeId)) {
+        txSinkPoolPktCounter++;
+    }
 }
 
 int 
@@ -426,6 +701,11 @@ main(int argc, char* argv[])
     std::string mobilityFile = "urban-low.tcl";
     std::string gnbPositionFile = "001-gnb.tcl";
     uint32_t seed = 1;
+    replication_config replication;
+    beam_cache_config beam_cache;
+    channel_cache_config channel_cache;
+    mec_config mec;
+    sidelink_zone_config sl_zone;
     double tx_power = 23; // dBm
 
     /* Parsing */
@@ -433,19 +713,38 @@ main(int argc, char* argv[])
     parse(cmd, log, 
         mobilityFile, 
         gnbPositionFile, 
-        outputDir, seed, argc, argv);
+        outputDir, seed, replication, beam_cache, channel_cache, mec, sl_zone, argc, argv);
+
+    NS_ABORT_MSG_IF(sl_zone.pools == 0 || sl_zone.pools > LteRrcSap::MAX_NUM_OF_TX_POOL,
+        "slPools must be between 1 and " << +LteRrcSap::MAX_NUM_OF_TX_POOL);
+    NS_ABORT_MSG_IF(beam_cache.enabled && (beam_cache.distance_step <= 0.0 || beam_cache.angle_step <= 0.0),
+        "beamCacheDistanceStep and beamCacheAngleStep must be > 0");
+    NS_ABORT_MSG_IF(replication.ci_level <= 0.0 || replication.ci_level >= 1.0,
+        "ciLevel must be between 0 and 1 (e.g. 0.95)");
+    NS_ABORT_MSG_IF(replication.max_runs > 0 && replication.parallel_runs == 0,
+        "parallelReplications must be at least 1");
+    std::filesystem::create_directories(outputDir);
+
+    /* Replications */
+    replication.absolute_half_widths["mec_queueing_mean_ms"] = mec.queueing_half_width;
+    replication.absolute_half_widths["sl_collision_ratio"] = sl_zone.collision_half_width;
+    if (replication.max_runs > 0) {
+        return run_replications(replication, outputDir, argc, argv);
+    }
 
     /* Global Configurations */
     global_config();
 
     RngSeedManager::SetSeed(seed);
-    RngSeedManager::SetRun(1);
+    RngSeedManager::SetRun(replication.run);
 
     /* Mobility and Positioning */
     std::string full_filename = mobility_path / mobilityFile;
     std::cout << "Loading node's mobility: " << full_filename << '\n';
-    mob_info info = get_mob_info(full_filename);
+    mob_info info = is_fcd_file(full_filename) ?
+        get_fcd_mob_info(full_filename) : get_mob_info(full_filename);
     std::cout << get_mob_info_str(info) << '\n';
+    NS_ABORT_MSG_IF(info.nodes < 2, "The mobility trace needs at least 2 vehicles (transmitter and sink)");
     std::string full_gnb_filename = mobility_path / gnbPositionFile;
     std::cout << "Loading GNb's positions: " << full_gnb_filename << '\n';
     NodeMap node_map = make_nodes_from_file(full_gnb_filename);
@@ -454,7 +753,9 @@ main(int argc, char* argv[])
     BuildingsHelper::Install(ue_nodes);
     Ptr<NrPointToPointEpcHelper> epc_helper = create_EPC_helper();
     uint8_t bwp_id_for_gbr_mcptt = 0;
-    Ptr<NrHelper> nr_helper = create_5GNR_helper(epc_helper, tx_power, bwp_id_for_gbr_mcptt);
+    Ptr<IdealBeamformingHelper> beamforming_helper = create_beamforming_helper(beam_cache);
+    Ptr<NrHelper> nr_helper = create_5GNR_helper(epc_helper, beamforming_helper,
+        tx_power, bwp_id_for_gbr_mcptt);
     // show_nodes_info(gnbNodes, ueNodes);
 
     /* Simulation Time */
@@ -471,6 +772,9 @@ main(int argc, char* argv[])
     );
     nr_helper->InitializeOperationBand(&band_01);
     BandwidthPartInfoPtrVector all_bwps = CcBwpCreator::GetAllBwps({band_01});
+    auto channel_caches = install_channel_cache(all_bwps, channel_cache, !channel_cache.enabled ? 0 :
+        get_channel_cache_key(seed, replication.run, full_filename, full_gnb_filename,
+            create_operation_band()));
 
     NetDeviceContainer gnbNetDevices = nr_helper->InstallGnbDevice(gnb_nodes, all_bwps);
     for (auto it = gnbNetDevices.Begin(); it != gnbNetDevices.End(); ++it) {
@@ -490,17 +794,26 @@ main(int argc, char* argv[])
     nr_sidelink_helper->PrepareUeForSidelink(ue_devices, bwp_id_set);
     /*  ---- Sidelink resource pool configuration ---- */
     // auto sidelink_pool_factory = create_preconfigure_sidelink_resource_pool_factory();
-    auto sidelink_pool = create_preconfigured_sidelink_resource_pool_factory()->CreatePool();
-    auto sidelink_pool_id = create_pool_id(0);
-    auto sidelink_pool_config = configure_sidelink_pool(sidelink_pool_id, sidelink_pool);
+    auto tdd_uplink_downlink_config = create_tdd_uplink_downlink_config();
+    sidelinkSlots = get_sidelink_slots(tdd_uplink_downlink_config.tddPattern);
+    uint16_t sidelink_slots = std::count(sidelinkSlots.begin(), sidelinkSlots.end(), true);
     LteRrcSap::SlBwpPoolConfigCommonNr array_of_sidelink_pool = create_array_of_sidelink_pool();
-    insert_pool_in_array(array_of_sidelink_pool, sidelink_pool_id.id, sidelink_pool_config);
+    for (uint16_t pool = 0; pool < sl_zone.pools; ++pool) {
+        auto sidelink_pool = create_preconfigured_sidelink_resource_pool_factory(pool, sl_zone.pools,
+            sidelink_slots)->CreatePool();
+        auto sidelink_pool_id = create_pool_id(pool);
+        auto sidelink_pool_config = configure_sidelink_pool(sidelink_pool_id, sidelink_pool);
+        insert_pool_in_array(array_of_sidelink_pool, sidelink_pool_id.id, sidelink_pool_config);
+    }
     auto bwp = create_bwp_information_element();
     auto bwp_generic = create_bwp_generic(bwp);
-    auto bwp_config = create_bwp_config_common(bwp_generic, array_of_sidelink_pool);
-    auto sidelink_frequency_config = create_sidelink_frequency_config(bwp_id_set, bwp_config);
-    auto tdd_uplink_downlink_config = create_tdd_uplink_downlink_config();
+    std::map<uint8_t, LteRrcSap::SlBwpConfigCommonNr> bwp_configs;
+    for (uint8_t bwp_id : bwp_id_set) {
+        bwp_configs[bwp_id] = create_bwp_config_common(bwp_generic, array_of_sidelink_pool);
+    }
+    auto sidelink_frequency_config = create_sidelink_frequency_config(bwp_configs);
     auto sidelink_general_config = create_sidelink_general_config(tdd_uplink_downlink_config);
+    slotDurationMs = 1.0 / (1 << bwp.numerology);
     auto pssch_params =  create_physical_sidelink_shared_channel_parameters();
     auto pssch_tx_config = create_physical_sidelink_shared_tx_config_list(0, pssch_params);
     auto sidelink_ue_selected_config = create_sidelink_ue_selected_config(0.0, pssch_tx_config);
@@ -554,7 +867,13 @@ main(int argc, char* argv[])
     std::string data_rate_str = std::to_string(data_rate) + "kb/s";
     std::cout << "Data rate " << DataRate(data_rate_str) << '\n';
     sidelink_client.SetConstantRate(DataRate(data_rate_str), udp_packet_size);
-    ApplicationContainer client_apps = sidelink_client.Install(ue_nodes.Get(0));
+    NodeContainer transmitter_nodes;
+    // the last vehicle runs the sink
+    uint32_t transmitters = std::max<uint32_t>(1, std::min(sl_zone.transmitters, ue_nodes.GetN() - 1));
+    for (uint32_t u = 0; u < transmitters; ++u) {
+        transmitter_nodes.Add(ue_nodes.Get(u));
+    }
+    ApplicationContainer client_apps = sidelink_client.Install(transmitter_nodes);
     client_apps.Start(final_sidelink_bearers_activation_time);
     client_apps.Stop(final_simulation_time);
 
@@ -566,11 +885,47 @@ main(int argc, char* argv[])
     std::cout << "App stop time at " << appStopTime << " sec" << std::endl;
 
     /* Configure server application */
+    // With slPools > 1 the sink, like every vehicle, only receives in the
+    // pool of its current zone (ActivePoolId), see README "Sidelink Zones".
     PacketSinkHelper sidelink_sink("ns3::UdpSocketFactory", local_addr);
     sidelink_sink.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
     ApplicationContainer server_apps = sidelink_sink.Install(ue_nodes.Get(ue_nodes.GetN() - 1));
     server_apps.Start(sidelink_bearers_activation_time);
 
+    /* MEC host behind the PGW, reached by the vehicles over Uu. Installed
+     * after the sidelink applications, which the statistics below expect at
+     * ApplicationList/0. */
+    NodeContainer mec_nodes;
+    ApplicationContainer mec_server_apps;
+    ApplicationContainer mec_client_apps;
+    if (mec.enabled) {
+        nr_helper->AttachToClosestGnb(ue_devices, gnbNetDevices);
+        uint16_t mec_port = 5000;
+        Ipv4Address mec_addr = create_mec_host(epc_helper, mec_nodes, mec);
+        ObjectFactory server_factory("ns3::MecServerApplication");
+        server_factory.Set("Port", UintegerValue(mec_port));
+        server_factory.Set("ResponseSize", UintegerValue(mec.response_size));
+        server_factory.Set("ServiceTime", StringValue(get_service_time_str(mec)));
+        Ptr<Application> server = server_factory.Create<Application>();
+        mec_nodes.Get(0)->AddApplication(server);
+        mec_server_apps.Add(server);
+        ObjectFactory client_factory("ns3::MecOffloadClientApplication");
+        client_factory.Set("RemoteAddress", AddressValue(InetSocketAddress(mec_addr, mec_port)));
+        client_factory.Set("RequestSize", UintegerValue(mec.request_size));
+        client_factory.Set("Interval", TimeValue(MilliSeconds(mec.request_interval)));
+        client_factory.Set("ExponentialInterval", BooleanValue(mec.exponential_requests));
+        uint32_t clients = (mec.clients > 0) ? std::min(mec.clients, ue_nodes.GetN()) : ue_nodes.GetN();
+        for (uint32_t u = 0; u < clients; ++u) {
+            Ptr<Application> client = client_factory.Create<Application>();
+            ue_nodes.Get(u)->AddApplication(client);
+            mec_client_apps.Add(client);
+        }
+    }
+
+    mec_server_apps.Start(sidelink_bearers_activation_time);
+    mec_client_apps.Start(final_sidelink_bearers_activation_time);
+    mec_client_apps.Stop(final_simulation_time);
+
     /* Statistics */
     std::ostringstream path;
     path << "/NodeList/" << ue_nodes.Get(ue_nodes.GetN() - 1)->GetId()
@@ -578,11 +933,29 @@ main(int argc, char* argv[])
     Config::ConnectWithoutContext(path.str(), MakeCallback(&ReceivePacket));
     path.str("");
 
-    path << "/NodeList/" << ue_nodes.Get(0)->GetId()
-         << "/ApplicationList/0/$ns3::OnOffApplication/Tx";
-    Config::ConnectWithoutContext(path.str(), MakeCallback(&TransmitPacket));
+    path << "/NodeList/" << ue_nodes.Get(ue_nodes.GetN() - 1)->GetId()
+         << "/ApplicationList/0/$ns3::PacketSink/RxWithSeqTsSize";
+    Config::ConnectWithoutContext(path.str(), MakeCallback(&ReceivePacketWithHeader));
     path.str("");
 
+    for (uint32_t u = 0; u < transmitter_nodes.GetN(); ++u) {
+        path << "/NodeList/" << transmitter_nodes.Get(u)->GetId()
+             << "/ApplicationList/0/$ns3::OnOffApplication/Tx";
+        Config::ConnectWithoutContext(path.str(),
+            MakeBoundCallback(&TransmitPacket, transmitter_nodes.Get(u)->GetId()));
+        path.str("");
+    }
+
+    /* Sidelink pools */
+    poolStats.resize(sl_zone.pools);
+    collisionRange = sl_zone.collision_range;
+    sinkNodeId = ue_nodes.Get(ue_nodes.GetN() - 1)->GetId();
+    Simulator::Schedule(final_sidelink_bearers_activation_time,
+        &assign_sidelink_pools, ue_devices, sl_zone, bwp_id_for_gbr_mcptt);
+    Config::ConnectWithoutContext(
+        "/NodeList/*/DeviceList/*/$ns3::NrUeNetDevice/ComponentCarrierMapUe/*/NrUeMac/SlPscchScheduling",
+        MakeCallback(&NotifySlPscchScheduling));
+
 
     /* Start Simulation */
     Simulator::Stop(final_simulation_time);
@@ -591,14 +964,66 @@ main(int argc, char* argv[])
 
     std::cout << "Total Tx bits = " << txByteCounter * 8 << std::endl;
     std::cout << "Total Tx packets = " << txPktCounter << std::endl;
+    std::cout << "Tx packets in the sink's pool = " << txSinkPoolPktCounter << std::endl;
 
     std::cout << "Total Rx bits = " << rxByteCounter * 8 << std::endl;
     std::cout << "Total Rx packets = " << rxPktCounter << std::endl;
 
-    std::cout << "Avrg thput = "
-              << (rxByteCounter * 8) / (final_simulation_time - Seconds(realAppStart)).GetSeconds() / 1000.0
-              << " kbps" << std::endl;
+    double throughput = (rxByteCounter * 8) / (final_simulation_time - Seconds(realAppStart)).GetSeconds() / 1000.0;
+    std::cout << "Avrg thput = " << throughput << " kbps" << std::endl;
+
+    std::cout << get_pool_stats_str(poolStats,
+        (final_simulation_time - final_sidelink_bearers_activation_time).GetSeconds());
+
+    if (auto cache = DynamicCast<CachedIdealBeamformingHelper>(beamforming_helper)) {
+        std::cout << cache->GetStatsStr() << std::endl;
+    }
+    for (auto& cache : channel_caches) {
+        std::cout << cache->GetStatsStr() << std::endl;
+        cache->Close();
+    }
 
+    Metrics metrics;
+    metrics["throughput_kbps"] = throughput;
+    if (txSinkPoolPktCounter > 0) {
+        metrics["pdr"] = static_cast<double>(rxPktCounter) / txSinkPoolPktCounter;
+    }
+    if (!rxLatencies.empty()) {
+        metrics["latency_p50_ms"] = get_percentile(rxLatencies, 50);
+        metrics["latency_p95_ms"] = get_percentile(rxLatencies, 95);
+        metrics["latency_p99_ms"] = get_percentile(rxLatencies, 99);
+    }
+    uint64_t occupied = 0;
+    uint64_t collided = 0;
+    for (const pool_stats& ps : poolStats) {
+        occupied += ps.occupied;
+        collided += ps.collided;
+    }
+    if (occupied > 0) {
+        metrics["sl_collision_ratio"] = static_cast<double>(collided) / occupied;
+    }
+    if (mec.enabled) {
+        std::vector<double> rtts;
+        uint32_t requests = 0;
+        for (uint32_t i = 0; i < mec_client_apps.GetN(); ++i) {
+            auto client = DynamicCast<MecOffloadClientApplication>(mec_client_apps.Get(i));
+            rtts.insert(rtts.end(), client->GetRtts().begin(), client->GetRtts().end());
+            requests += client->GetSent();
+        }
+        auto server = DynamicCast<MecServerApplication>(mec_server_apps.Get(0));
+        std::cout << "MEC requests = " << requests << ", responses = " << rtts.size() << std::endl;
+        std::cout << server->GetStatsStr() << std::endl;
+        metrics["mec_queueing_mean_ms"] = server->GetMeanQueueingDelay() * 1000.0;
+        if (!rtts.empty()) {
+            metrics["mec_rtt_p50_ms"] = get_percentile(rtts, 50);
+            metrics["mec_rtt_p95_ms"] = get_percentile(rtts, 95);
+            metrics["mec_rtt_p99_ms"] = get_percentile(rtts, 99);
+            std::cout << "MEC RTT p50/p95/p99 = " << metrics["mec_rtt_p50_ms"] << "/"
+                      << metrics["mec_rtt_p95_ms"] << "/" << metrics["mec_rtt_p99_ms"]
+                      << " ms" << std::endl;
+        }
+    }
+    write_metrics(get_metrics_filename(outputDir, replication.run), metrics);
 
 
     /* End Simulation */
@@ -0,0 +1,245 @@
+/**
+* @file fcd-utils.h
+* @brief streaming SUMO floating car data (FCD) reader
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef FCD_UTILS
+#define FCD_UTILS
+
+#include "mob-utils.h"
+
+#include <cstdlib>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief xml tag
+ *
+ * @param name
+ * @param attributes
+ * @param closing true for </name>
+ * @param self_closing true for <name ... />
+ */
+struct xml_tag {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    bool closing = false;
+    bool self_closing = false;
+};
+
+/**
+ * @brief pull-based (SAX-style) xml tag reader
+ *
+ * Reads the input in fixed-size blocks and only keeps the current tag in
+ * memory, so the memory used does not depend on the file size. Text content,
+ * comments, processing instructions and doctypes are skipped; entities are
+ * not expanded.
+ */
+class xml_reader {
+public:
+    explicit xml_reader(std::istream& input, size_t block_size = 1 << 16)
+        : m_input(input), m_buffer(block_size) {}
+
+    bool next_tag(xml_tag& tag) {
+        int c;
+        while ((c = get()) != EOF) {
+            if (c != '<') continue;
+            c = get();
+            if (c == '?' || c == '!') {
+                skip_markup(c);
+                continue;
+            }
+            return read_tag(c, tag);
+        }
+        return false;
+    }
+
+private:
+    int get() {
+        if (m_pos == m_size) {
+            if (!m_input) return EOF;
+            m_input.read(m_buffer.data(), m_buffer.size());
+            m_size = m_input.gcount();
+            m_pos = 0;
+            if (m_size == 0) return EOF;
+        }
+        return static_cast<unsigned char>(m_buffer[m_pos++]);
+    }
+
+    void skip_markup(int c) {
+        // comment: <!-- ... -->, other markup ends at the first '>'
+        int a = get();
+        int b = (c == '!' && a == '-') ? get() : EOF;
+        if (c == '!' && a == '-' && b == '-') {
+            int dashes = 0;
+            while ((c = get()) != EOF) {
+                if (c == '>' && dashes >= 2) return;
+                dashes = (c == '-') ? dashes + 1 : 0;
+            }
+            return;
+        }
+        if (a == '>' || b == '>') return;
+        while ((c = get()) != EOF && c != '>') {}
+    }
+
+    bool read_tag(int c, xml_tag& tag) {
+        tag.name.clear();
+        tag.attributes.clear();
+        tag.closing = (c == '/');
+        tag.self_closing = false;
+        if (tag.closing) c = get();
+        while (c != EOF && !is_space(c) && c != '>' && c != '/') {
+            tag.name.push_back(c);
+            c = get();
+        }
+        while (c != EOF && c != '>') {
+            if (c == '/') {
+                tag.self_closing = true;
+            } else if (!is_space(c)) {
+                std::string key, value;
+                while (c != EOF && c != '=' && !is_space(c) && c != '>') {
+                    key.push_back(c);
+                    c = get();
+                }
+                while (c != EOF && c != '"' && c != '\'' && c != '>') c = get();
+                if (c == '"' || c == '\'') {
+                    int quote = c;
+                    while ((c = get()) != EOF && c != quote) value.push_back(c);
+                }
+                tag.attributes.emplace_back(std::move(key), std::move(value));
+                if (c == '>') break;
+            }
+            c = get();
+        }
+        return c == '>';
+    }
+
+    static bool is_space(int c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    std::istream& m_input;
+    std::vector<char> m_buffer;
+    size_t m_pos = 0;
+    size_t m_size = 0;
+};
+
+const std::string* get_attribute(const xml_tag& tag, std::string_view key) {
+    for (const auto& [k, v]: tag.attributes) {
+        if (k == key) return &v;
+    }
+    return nullptr;
+}
+
+double get_attribute_double(const xml_tag& tag, std::string_view key, double default_value = 0.0) {
+    const std::string* value = get_attribute(tag, key);
+    return value ? std::strtod(value->c_str(), nullptr) : default_value;
+}
+
+/**
+ * @brief fcd vehicle position at a timestep
+ *
+ * @param node_id dense index of the SUMO vehicle id (order of first appearance)
+ * @param x
+ * @param y
+ * @param z
+ */
+struct fcd_position {
+    uint32_t node_id = 0;
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+};
+
+/**
+ * @brief reads a SUMO fcd-export file one <timestep> at a time
+ *
+ * SUMO vehicle string ids are mapped to dense node indices in order of first
+ * appearance, so two readers over the same file produce the same indices.
+ */
+class fcd_reader {
+public:
+    explicit fcd_reader(std::istream& input) : m_xml(input) {}
+
+    /**
+     * @brief reads the next timestep, positions is overwritten
+     * @return false when there are no more timesteps
+     */
+    bool next_timestep(double& time, std::vector<fcd_position>& positions) {
+        positions.clear();
+        while (m_xml.next_tag(m_tag)) {
+            if (m_tag.closing || m_tag.name != "timestep") continue;
+            time = get_attribute_double(m_tag, "time");
+            if (m_tag.self_closing) return true;
+            while (m_xml.next_tag(m_tag)) {
+                if (m_tag.name == "timestep" && m_tag.closing) break;
+                if (m_tag.closing || m_tag.name != "vehicle") continue;
+                const std::string* id = get_attribute(m_tag, "id");
+                if (id == nullptr) {
+                    std::cerr << "Error parsing vehicle id" << std::endl;
+                    continue; // Skip
+                }
+                positions.push_back(fcd_position{get_node_id(*id),
+                    get_attribute_double(m_tag, "x"),
+                    get_attribute_double(m_tag, "y"),
+                    get_attribute_double(m_tag, "z")});
+            }
+            return true;
+        }
+        return false;
+    }
+
+    size_t get_node_count() const {
+        return m_ids.size();
+    }
+
+private:
+    uint32_t get_node_id(const std::string& id) {
+        auto [it, inserted] = m_ids.try_emplace(id, m_ids.size());
+        return it->second;
+    }
+
+    xml_reader m_xml;
+    xml_tag m_tag;
+    std::unordered_map<std::string, uint32_t> m_ids;
+};
+
+bool is_fcd_file(std::string_view file) {
+    file = strip_compression_extension(file);
+    return file.size() >= 4 && file.substr(file.size() - 4) == ".xml";
+}
+
+mob_info get_fcd_mob_info(std::string_view file) {
+    mob_info info;
+    std::unique_ptr<std::istream> inputFile = open_file(file);
+    fcd_reader reader(*inputFile);
+    std::vector<fcd_position> positions;
+    double time = 0.0;
+    bool first = true;
+    while (reader.next_timestep(time, positions)) {
+        if (positions.empty()) continue;
+        for (const fcd_position& p: positions) {
+            if (p.node_id < info.first_positions.size()) continue;
+            info.first_positions.resize(p.node_id + 1);
+            info.first_positions[p.node_id] = node{p.node_id, p.x, p.y, p.z};
+        }
+        if (first || time < info.start_time) {
+            info.start_time = time;
+        }
+        if (first || time > info.end_time) {
+            info.end_time = time;
+        }
+        first = false;
+    }
+    info.nodes = reader.get_node_count();
+    return info;
+}
+
+#endif
@@ -0,0 +1,335 @@
+/**
+* @file mec-utils.h
+* @brief MEC edge server and V2I offload client applications
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef MEC_UTILS
+#define MEC_UTILS
+
+#include "ns3/application.h"
+#include "ns3/boolean.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/udp-socket-factory.h"
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * @brief MEC edge server: FIFO single-server queue over UDP
+ *
+ * Each request is queued, served for ServiceTime and answered with a
+ * ResponseSize packet carrying the request's SeqTsHeader, so the client can
+ * measure the round-trip time.
+ */
+class MecServerApplication : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::MecServerApplication")
+                .SetParent<Application>()
+                .AddConstructor<MecServerApplication>()
+                .AddAttribute("Port",
+                              "Listening port",
+                              UintegerValue(5000),
+                              MakeUintegerAccessor(&MecServerApplication::m_port),
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("ResponseSize",
+                              "Response size (bytes)",
+                              UintegerValue(100),
+                              MakeUintegerAccessor(&MecServerApplication::m_responseSize),
+                              MakeUintegerChecker<uint32_t>(12))
+                .AddAttribute("ServiceTime",
+                              "Compute time of a request (s)",
+                              StringValue("ns3::ConstantRandomVariable[Constant=0.005]"),
+                              MakePointerAccessor(&MecServerApplication::m_serviceTime),
+                              MakePointerChecker<RandomVariableStream>());
+        return tid;
+    }
+
+    uint64_t GetServed() const
+    {
+        return m_served;
+    }
+
+    /// mean time requests waited in the queue before service (s)
+    double GetMeanQueueingDelay() const
+    {
+        return (m_served > 0) ? m_queueingTime.GetSeconds() / m_served : 0.0;
+    }
+
+    size_t GetMaxQueueLength() const
+    {
+        return m_maxQueueLength;
+    }
+
+    /// busy fraction since start, a request in service counts up to Now
+    double GetUtilization() const
+    {
+        double elapsed = (Simulator::Now() - m_startTime).GetSeconds();
+        Time busy = m_busyTime + (m_busy ? Simulator::Now() - m_serviceStart : Time(0));
+        return (elapsed > 0.0) ? busy.GetSeconds() / elapsed : 0.0;
+    }
+
+    std::string GetStatsStr() const
+    {
+        std::stringstream ss;
+        ss << "MEC server: " << m_served << " requests served, mean queueing "
+           << GetMeanQueueingDelay() * 1000.0 << " ms, max queue " << m_maxQueueLength
+           << ", utilization " << GetUtilization() * 100.0 << "%";
+        return ss.str();
+    }
+
+  private:
+    struct Request
+    {
+        SeqTsHeader header;
+        Address from;
+        Time arrival;
+    };
+
+    void StartApplication() override
+    {
+        m_startTime = Simulator::Now();
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->SetRecvCallback(MakeCallback(&MecServerApplication::HandleRead, this));
+    }
+
+    void StopApplication() override
+    {
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        }
+        Simulator::Cancel(m_serviceEvent);
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            Request request;
+            packet->RemoveHeader(request.header);
+            request.from = from;
+            request.arrival = Simulator::Now();
+            m_queue.push_back(request);
+            m_maxQueueLength = std::max(m_maxQueueLength, m_queue.size());
+            if (!m_busy)
+            {
+                StartService();
+            }
+        }
+    }
+
+    void StartService()
+    {
+        m_queueingTime += Simulator::Now() - m_queue.front().arrival;
+        Time service = Seconds(m_serviceTime->GetValue());
+        m_busy = true;
+        m_serviceStart = Simulator::Now();
+        m_serviceEvent = Simulator::Schedule(service, &MecServerApplication::FinishService, this);
+    }
+
+    void FinishService()
+    {
+        Request request = m_queue.front();
+        m_queue.pop_front();
+        m_served++;
+        Ptr<Packet> response =
+            Create<Packet>(m_responseSize - std::min(m_responseSize, request.header.GetSerializedSize()));
+        response->AddHeader(request.header);
+        m_socket->SendTo(response, 0, request.from);
+        m_busy = false;
+        m_busyTime += Simulator::Now() - m_serviceStart;
+        if (!m_queue.empty())
+        {
+            StartService();
+        }
+    }
+
+    uint16_t m_port{5000};
+    uint32_t m_responseSize{100};
+    Ptr<RandomVariableStream> m_serviceTime;
+    Ptr<Socket> m_socket;
+    std::deque<Request> m_queue;
+    EventId m_serviceEvent;
+    bool m_busy{false};
+    Time m_startTime;
+    Time m_queueingTime;
+    Time m_serviceStart;
+    Time m_busyTime;
+    uint64_t m_served{0};
+    size_t m_maxQueueLength{0};
+};
+
+/**
+ * @brief periodic offload requests to a MEC server, records round-trip times
+ *
+ * The first request is sent after a random offset in [0, Interval), so
+ * clients started together do not reach the server as one burst per period;
+ * with ExponentialInterval the requests form a Poisson process instead.
+ */
+class MecOffloadClientApplication : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::MecOffloadClientApplication")
+                .SetParent<Application>()
+                .AddConstructor<MecOffloadClientApplication>()
+                .AddAttribute("RemoteAddress",
+                              "MEC server address",
+                              AddressValue(),
+                              MakeAddressAccessor(&MecOffloadClientApplication::m_remote),
+                              MakeAddressChecker())
+                .AddAttribute("RequestSize",
+                              "Request size (bytes)",
+                              UintegerValue(500),
+                              MakeUintegerAccessor(&MecOffloadClientApplication::m_requestSize),
+                              MakeUintegerChecker<uint32_t>(12))
+                .AddAttribute("Interval",
+                              "Time between requests",
+                              TimeValue(MilliSeconds(100)),
+                              MakeTimeAccessor(&MecOffloadClientApplication::m_interval),
+                              MakeTimeChecker())
+                .AddAttribute("ExponentialInterval",
+                              "Exponentially distributed time between requests, with mean Interval",
+                              BooleanValue(false),
+                              MakeBooleanAccessor(&MecOffloadClientApplication::m_exponential),
+                              MakeBooleanChecker());
+        return tid;
+    }
+
+    MecOffloadClientApplication()
+        : m_uniform(CreateObject<UniformRandomVariable>()),
+          m_exponentialRv(CreateObject<ExponentialRandomVariable>())
+    {
+    }
+
+    uint32_t GetSent() const
+    {
+        return m_sent;
+    }
+
+    /// round-trip times of the answered requests (ms)
+    const std::vector<double>& GetRtts() const
+    {
+        return m_rtts;
+    }
+
+  private:
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+        m_socket->Connect(m_remote);
+        m_socket->SetRecvCallback(MakeCallback(&MecOffloadClientApplication::HandleRead, this));
+        Time offset = Seconds(m_uniform->GetValue(0.0, m_interval.GetSeconds()));
+        m_sendEvent = Simulator::Schedule(offset, &MecOffloadClientApplication::Send, this);
+    }
+
+    void StopApplication() override
+    {
+        Simulator::Cancel(m_sendEvent);
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        }
+    }
+
+    void Send()
+    {
+        SeqTsHeader header;
+        header.SetSeq(m_sent++);
+        Ptr<Packet> packet =
+            Create<Packet>(m_requestSize - std::min(m_requestSize, header.GetSerializedSize()));
+        packet->AddHeader(header);
+        m_socket->Send(packet);
+        Time interval = m_exponential
+            ? Seconds(m_exponentialRv->GetValue(m_interval.GetSeconds(), 0.0))
+            : m_interval;
+        m_sendEvent = Simulator::Schedule(interval, &MecOffloadClientApplication::Send, this);
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()))
+        {
+            SeqTsHeader header;
+            packet->RemoveHeader(header);
+            m_rtts.push_back((Simulator::Now() - header.GetTs()).GetSeconds() * 1000.0);
+        }
+    }
+
+    Address m_remote;
+    uint32_t m_requestSize{500};
+    Time m_interval{MilliSeconds(100)};
+    bool m_exponential{false};
+    Ptr<UniformRandomVariable> m_uniform;
+    Ptr<ExponentialRandomVariable> m_exponentialRv;
+    Ptr<Socket> m_socket;
+    EventId m_sendEvent;
+    uint32_t m_sent{0};
+    std::vector<double> m_rtts;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(MecServerApplication);
+NS_OBJECT_ENSURE_REGISTERED(MecOffloadClientApplication);
+
+} // namespace ns3
+
+/**
+ * @brief mec config
+ *
+ * @param enabled attach the vehicles to the gNBs and run the offload traffic
+ * @param backhaul_delay PGW <-> MEC host link delay (ms)
+ * @param service_time mean compute time per request (ms)
+ * @param exponential_service exponential instead of constant service time
+ * @param request_size (bytes)
+ * @param response_size (bytes)
+ * @param request_interval time between requests of a vehicle (ms)
+ * @param exponential_requests exponential instead of constant time between
+ * requests
+ * @param clients number of offloading vehicles, 0 for all
+ * @param queueing_half_width replication target half-width of the mean
+ * queueing delay (ms), absolute since the delay is ~0 at low load
+ */
+struct mec_config {
+    bool enabled = false;
+    double backhaul_delay = 5.0;
+    double service_time = 5.0;
+    bool exponential_service = false;
+    uint32_t request_size = 500;
+    uint32_t response_size = 100;
+    double request_interval = 100.0;
+    bool exponential_requests = false;
+    uint32_t clients = 0;
+    double queueing_half_width = 0.5;
+};
+
+#endif
@@ -10,11 +10,18 @@
 #ifndef MOB_UTILS
 #define MOB_UTILS
 
+#include <cerrno>
+#include <csignal>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream> 
+#include <streambuf>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 /**
  * @brief node
@@ -54,31 +61,222 @@ struct mob {
  * @param start_time 
  * @param end_time 
  * @param nodes 
+ * @param first_positions first position of each node (FCD traces only)
  */
 struct mob_info {
     double start_time = 0.0;
     double end_time = 0.0;
     uint32_t nodes = 0;
+    std::vector<node> first_positions;
 };
 
 using NodeMap = std::unordered_map<uint32_t, node>;
 
-std::ifstream open_file(std::string_view file) {
-    std::ifstream inputFile(file.data()); // Open the file in text mode
+/**
+ * @brief decompressor process
+ *
+ * @param pid decompressor process id
+ * @param fd read end of the pipe with the decompressed data
+ */
+struct decompressor {
+    pid_t pid = -1;
+    int fd = -1;
+};
+
+/**
+ * @brief decompression tool for the file extension, nullptr for plain text
+ */
+const char* get_decompressor_tool(std::string_view file) {
+    auto ends_with = [file](std::string_view ext) {
+        return file.size() >= ext.size() && file.substr(file.size() - ext.size()) == ext;
+    };
+    if (ends_with(".gz")) return "gzip";
+    if (ends_with(".zst")) return "zstd";
+    return nullptr;
+}
+
+bool is_compressed_file(std::string_view file) {
+    return get_decompressor_tool(file) != nullptr;
+}
+
+std::string_view strip_compression_extension(std::string_view file) {
+    if (!is_compressed_file(file)) return file;
+    return file.substr(0, file.rfind('.'));
+}
+
+void check_file(std::string_view file) {
+    std::ifstream inputFile(file.data());
     if (!inputFile.is_open()) {
         std::cerr << "Error opening file: " << file << std::endl;
         exit(EXIT_FAILURE);
     }
-    return inputFile;
+}
+
+/**
+ * @brief starts `gzip -dc`/`zstd -dc` on file, writing into a pipe
+ *
+ * Decompression runs in its own process, concurrently with the parser, and
+ * nothing is extracted to disk.
+ */
+decompressor start_decompressor(std::string_view file) {
+    check_file(file);
+    const char* tool = get_decompressor_tool(file);
+    std::string path(file);
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "Error creating pipe for " << file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    decompressor result;
+    result.pid = fork();
+    if (result.pid == 0) {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+        execlp(tool, tool, "-dc", "--", path.c_str(), (char*)nullptr);
+        std::cerr << "Error running " << tool << std::endl;
+        _exit(127);
+    }
+    close(fds[1]);
+    if (result.pid < 0) {
+        std::cerr << "Error starting " << tool << " for " << file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    result.fd = fds[0];
+    return result;
+}
+
+/**
+ * @brief stops the decompressor
+ *
+ * When the reader reached the end of the data (eof), the rest of the pipe is
+ * drained and the tool's exit status checked, so a corrupt or truncated
+ * archive exits instead of being read as a shorter trace. Otherwise the
+ * reader stopped early: the tool is killed and its status ignored, instead
+ * of decompressing the rest of the archive for nothing.
+ */
+void stop_decompressor(decompressor& d, bool eof = true) {
+    pid_t pid = d.pid;
+    if (!eof && pid > 0) kill(pid, SIGTERM);
+    if (d.fd >= 0) {
+        char buffer[1 << 12];
+        ssize_t n;
+        while (eof && ((n = read(d.fd, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR))) {}
+        close(d.fd);
+    }
+    d = decompressor{};
+    if (pid <= 0) return;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            std::cerr << "Error waiting for the decompressor" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (eof && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+        std::cerr << "Error decompressing file: corrupt or truncated archive" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief path naming the decompressed data, for readers that take a filename
+ */
+std::string get_decompressor_path(const decompressor& d) {
+    return "/dev/fd/" + std::to_string(d.fd);
+}
+
+/**
+ * @brief block-buffered streambuf over a file descriptor
+ */
+class fd_streambuf : public std::streambuf {
+public:
+    explicit fd_streambuf(int fd, size_t block_size = 1 << 16)
+        : m_fd(fd), m_buffer(block_size) {}
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        ssize_t n;
+        do {
+            n = read(m_fd, m_buffer.data(), m_buffer.size());
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) return traits_type::eof();
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    int m_fd;
+    std::vector<char> m_buffer;
+};
+
+/**
+ * @brief streambuf over the output of a decompressor
+ *
+ * The decompressor is checked when the data ends, so a corrupt archive is
+ * reported while reading rather than from a destructor; a buffer destroyed
+ * before the end only kills it.
+ */
+class decompressed_streambuf : public fd_streambuf {
+public:
+    explicit decompressed_streambuf(std::string_view file)
+        : decompressed_streambuf(start_decompressor(file)) {}
+
+    ~decompressed_streambuf() override {
+        stop_decompressor(m_decompressor, false);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (m_decompressor.pid <= 0) return traits_type::eof();
+        int_type c = fd_streambuf::underflow();
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            stop_decompressor(m_decompressor);
+        }
+        return c;
+    }
+
+private:
+    explicit decompressed_streambuf(decompressor d)
+        : fd_streambuf(d.fd), m_decompressor(d) {}
+
+    decompressor m_decompressor;
+};
+
+/**
+ * @brief istream over the output of a decompressor
+ */
+class decompressed_stream : public std::istream {
+public:
+    explicit decompressed_stream(std::string_view file)
+        : std::istream(nullptr), m_buffer(file) {
+        rdbuf(&m_buffer);
+    }
+
+private:
+    decompressed_streambuf m_buffer;
+};
+
+/**
+ * @brief opens a plain text, gzip (.gz) or zstd (.zst) file
+ */
+std::unique_ptr<std::istream> open_file(std::string_view file) {
+    if (is_compressed_file(file)) {
+        return std::make_unique<decompressed_stream>(file);
+    }
+    check_file(file);
+    return std::make_unique<std::ifstream>(file.data()); // Open the file in text mode
 }
 
 mob_info get_mob_info(std::string_view file) {
     mob_info info;
-    std::ifstream inputFile = open_file(file);
+    std::unique_ptr<std::istream> inputFile = open_file(file);
     std::string line;
     double currentTime = 0.0;
     std::unordered_set<uint32_t> uniqueNodeIds;
-    while (std::getline(inputFile, line)) {
+    while (std::getline(*inputFile, line)) {
         std::istringstream iss(line);
         std::string command;
         iss >> command;
@@ -116,7 +314,6 @@ mob_info get_mob_info(std::string_view file) {
         }
     }
     info.nodes = uniqueNodeIds.size();
-    inputFile.close();
     return info;
 }
 
@@ -129,10 +326,10 @@ std::string get_mob_info_str(const mob_info& info) {
 }
 
 NodeMap make_nodes_from_file(std::string_view file) {
-    std::ifstream input = open_file(file);
+    std::unique_ptr<std::istream> input = open_file(file);
     std::unordered_map<uint32_t, node> nodes_map;
     std::string line;
-    while (std::getline(input, line)) {
+    while (std::getline(*input, line)) {
         if (line.find("setdest") != std::string::npos) continue;
         size_t pos = line.find("$node_(");
         if (pos != std::string::npos) {\
@@ -166,7 +363,6 @@ NodeMap make_nodes_from_file(std::string_view file) {
             }
         }
     }
-    input.close();
     return nodes_map;
 }
 
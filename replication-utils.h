@@ -0,0 +1,340 @@
+/**
+* @file replication-utils.h
+* @brief sequential-stopping replication controller
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef REPLICATION_UTILS
+#define REPLICATION_UTILS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief replication config
+ *
+ * @param run RngSeedManager run number of this process
+ * @param max_runs maximum number of replications (0 disables the controller)
+ * @param min_runs replications before the stopping rule is evaluated
+ * @param parallel_runs replications executed at the same time
+ * @param ci_level confidence level of the intervals (e.g. 0.95)
+ * @param ci_half_width target half-width, relative to the metric mean
+ * @param absolute_half_widths metrics with an absolute target half-width (in
+ * the metric's unit) instead, for means that can be close to zero
+ */
+struct replication_config {
+    uint32_t run = 1;
+    uint32_t max_runs = 0;
+    uint32_t min_runs = 3;
+    uint32_t parallel_runs = 4;
+    double ci_level = 0.95;
+    double ci_half_width = 0.05;
+    std::map<std::string, double> absolute_half_widths;
+};
+
+/**
+ * @brief running mean and variance (Welford)
+ *
+ * @param n
+ * @param mean
+ * @param m2 sum of squared deviations from the mean
+ */
+struct running_stats {
+    uint32_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+};
+
+using Metrics = std::map<std::string, double>;
+
+void update_stats(running_stats& stats, double value) {
+    stats.n++;
+    double delta = value - stats.mean;
+    stats.mean += delta / stats.n;
+    stats.m2 += delta * (value - stats.mean);
+}
+
+double get_variance(const running_stats& stats) {
+    return (stats.n > 1) ? stats.m2 / (stats.n - 1) : 0.0;
+}
+
+/**
+ * @brief continued fraction of the regularized incomplete beta function
+ * (modified Lentz's method)
+ */
+double incomplete_beta_fraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    if (std::fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        double aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1.0 + aa * d;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+        aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1.0 + aa * d;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double delta = d * c;
+        h *= delta;
+        if (std::fabs(delta - 1.0) < 1e-15) break;
+    }
+    return h;
+}
+
+/**
+ * @brief regularized incomplete beta function I_x(a, b)
+ */
+double incomplete_beta(double a, double b, double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                            a * std::log(x) + b * std::log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return front * incomplete_beta_fraction(a, b, x) / a;
+    }
+    return 1.0 - front * incomplete_beta_fraction(b, a, 1.0 - x) / b;
+}
+
+/**
+ * @brief Student's t CDF for df degrees of freedom
+ */
+double t_cdf(double t, uint32_t df) {
+    double tail = 0.5 * incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+    return (t >= 0.0) ? 1.0 - tail : tail;
+}
+
+/**
+ * @brief Student's t quantile for df degrees of freedom, 0.5 <= p < 1
+ *
+ * Inverts t_cdf() by bisection, accurate to ~1e-9.
+ */
+double t_quantile(double p, uint32_t df) {
+    if (!(p < 1.0)) return INFINITY;
+    double lo = 0.0;
+    double hi = 1.0;
+    // t(1 - 1e-12, 1) is ~3e11, so 64 doublings bracket any p < 1
+    for (int i = 0; i < 64 && t_cdf(hi, df) < p; i++) {
+        lo = hi;
+        hi *= 2.0;
+    }
+    for (int i = 0; i < 100 && hi - lo > 1e-9 * hi; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (t_cdf(mid, df) < p) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+/**
+ * @brief confidence interval half-width of the mean
+ */
+double get_half_width(const running_stats& stats, double level) {
+    if (stats.n < 2) return INFINITY;
+    double t = t_quantile(1.0 - (1.0 - level) / 2.0, stats.n - 1);
+    return t * std::sqrt(get_variance(stats) / stats.n);
+}
+
+bool is_converged(const std::string& key, const running_stats& stats,
+    const replication_config& config) {
+    if (stats.n < std::max<uint32_t>(config.min_runs, 2)) return false;
+    double hw = get_half_width(stats, config.ci_level);
+    auto absolute = config.absolute_half_widths.find(key);
+    if (absolute != config.absolute_half_widths.end()) return hw < absolute->second;
+    if (stats.mean == 0.0) return hw == 0.0;
+    return hw / std::fabs(stats.mean) < config.ci_half_width;
+}
+
+/**
+ * @brief nearest-rank percentile, sorts values in place
+ */
+double get_percentile(std::vector<double>& values, double percentile) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+    rank = std::clamp<size_t>(rank, 1, values.size());
+    return values[rank - 1];
+}
+
+std::string get_metrics_filename(const std::string& outputDir, uint32_t run) {
+    std::stringstream ss;
+    ss << outputDir << "/metrics-run-" << run << ".txt";
+    return ss.str();
+}
+
+/**
+ * @brief writes the metrics of a run, exits on failure so the controller
+ * never counts a run without metrics
+ */
+void write_metrics(const std::string& file, const Metrics& metrics) {
+    std::ofstream output(file);
+    if (!output.is_open()) {
+        std::cerr << "Error opening file: " << file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    output << std::setprecision(12);
+    for (const auto& [key, value]: metrics) {
+        output << key << " " << value << "\n";
+    }
+    output.close();
+    if (output.fail()) {
+        std::cerr << "Error writing file: " << file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief reads the metrics of a run, false if the file is missing or empty
+ */
+bool read_metrics(const std::string& file, Metrics& metrics) {
+    std::ifstream input(file);
+    if (!input.is_open()) return false;
+    std::string key;
+    double value = 0.0;
+    while (input >> key >> value) {
+        metrics[key] = value;
+    }
+    return !metrics.empty();
+}
+
+/**
+ * @brief re-executes this program as replication `run`, output goes to a log
+ */
+pid_t spawn_replication(int argc, char* argv[], const std::string& outputDir, uint32_t run) {
+    std::vector<std::string> args(argv, argv + argc);
+    args.push_back("--run=" + std::to_string(run));
+    args.push_back("--replications=0");
+    std::string log_file = outputDir + "/run-" + std::to_string(run) + ".log";
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        } else {
+            std::cerr << "Error opening file: " << log_file << std::endl;
+        }
+        std::vector<char*> child_argv;
+        for (std::string& arg: args) child_argv.push_back(arg.data());
+        child_argv.push_back(nullptr);
+        execv("/proc/self/exe", child_argv.data());
+        execvp(child_argv[0], child_argv.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+std::string get_replication_report_str(const std::map<std::string, running_stats>& stats,
+    const replication_config& config, uint32_t runs, bool converged) {
+    std::stringstream ss;
+    ss << "Replications: " << runs
+       << (converged ? " (converged)" : " (max runs reached)") << "\n";
+    ss << "Confidence level: " << config.ci_level
+       << ", target relative half-width: " << config.ci_half_width << "\n";
+    for (const auto& [key, s]: stats) {
+        double hw = get_half_width(s, config.ci_level);
+        ss << key << ": mean " << s.mean
+           << " +/- " << hw;
+        auto absolute = config.absolute_half_widths.find(key);
+        if (absolute != config.absolute_half_widths.end()) {
+            ss << " (target " << absolute->second;
+        } else {
+            ss << " (rel " << ((s.mean != 0.0) ? hw / std::fabs(s.mean) : 0.0);
+        }
+        ss << ", n " << s.n << ")\n";
+    }
+    return ss.str();
+}
+
+/**
+ * @brief runs replications in parallel processes until every metric converged
+ *
+ * Runs are numbered 1..max_runs and passed to the child as `--run`; each
+ * child writes its metrics with write_metrics() before exiting. Runs still in
+ * flight when the stopping rule fires are waited for and included.
+ *
+ * @return process exit status
+ */
+int run_replications(const replication_config& config, const std::string& outputDir,
+    int argc, char* argv[]) {
+    std::map<pid_t, uint32_t> running;
+    std::map<std::string, running_stats> stats;
+    uint32_t next_run = 1;
+    uint32_t completed = 0;
+    bool converged = false;
+    while (!running.empty() || (!converged && next_run <= config.max_runs)) {
+        while (!converged && next_run <= config.max_runs && running.size() < config.parallel_runs) {
+            // never count the metrics of an earlier sweep in the same outputDir
+            std::remove(get_metrics_filename(outputDir, next_run).c_str());
+            pid_t pid = spawn_replication(argc, argv, outputDir, next_run);
+            if (pid < 0) {
+                std::cerr << "Error starting replication " << next_run << std::endl;
+                return EXIT_FAILURE;
+            }
+            running[pid] = next_run++;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+        uint32_t run = it->second;
+        running.erase(it);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Replication " << run << " failed, see "
+                      << outputDir << "/run-" << run << ".log" << std::endl;
+            continue;
+        }
+        Metrics metrics;
+        if (!read_metrics(get_metrics_filename(outputDir, run), metrics)) {
+            std::cerr << "Replication " << run << " wrote no metrics, see "
+                      << outputDir << "/run-" << run << ".log" << std::endl;
+            continue;
+        }
+        for (const auto& [key, value]: metrics) {
+            update_stats(stats[key], value);
+        }
+        completed++;
+        converged = !stats.empty() && std::all_of(stats.begin(), stats.end(),
+            [&config](const auto& s) { return is_converged(s.first, s.second, config); });
+        std::cout << "Replication " << run << " done (" << completed << " runs)\n";
+    }
+    std::string report = get_replication_report_str(stats, config, completed, converged);
+    std::cout << report;
+    std::ofstream output(outputDir + "/replications.txt");
+    output << report;
+    if (completed == 0) {
+        std::cerr << "No replication completed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,220 @@
+/**
+* @file sl-zone-utils.h
+* @brief zone-based sidelink resource pool assignment and per-pool statistics
+* @version 0.1
+* @date 2026-10-18
+*
+* @author: Sérgio Vieira - sergio.vieira@ifce.edu.br
+**/
+
+#ifndef SL_ZONE_UTILS
+#define SL_ZONE_UTILS
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief sidelink zone config
+ *
+ * @param pools number of resource pools, 1 keeps the single default pool
+ * @param zone_length side of a square zone (m)
+ * @param update_period how often vehicles are reassigned to pools (ms)
+ * @param transmitters number of vehicles running the groupcast client
+ * @param collision_range distance below which two vehicles on the same
+ * subchannel-slot collide (m); farther apart they reuse it spatially
+ * @param collision_half_width replication target half-width of the collision
+ * ratio, absolute since the ratio is ~0 at low load
+ */
+struct sidelink_zone_config {
+    uint16_t pools = 1;
+    double zone_length = 100.0;
+    double update_period = 100.0;
+    uint32_t transmitters = 1;
+    double collision_range = 200.0;
+    double collision_half_width = 0.01;
+};
+
+/**
+ * @brief row shift of the zone reuse pattern
+ *
+ * Shift 1 keeps zones sharing an edge apart; shift 2 also keeps diagonal
+ * neighbours apart, which needs at least 4 pools.
+ */
+int64_t get_zone_shift(uint16_t pools) {
+    return (pools >= 4) ? 2 : 1;
+}
+
+/**
+ * @brief zone id of a position, one zone id per pool
+ *
+ * TS 38.331 numbers zones y1 * Nx + x1 over an Nx x Ny tile. A tile of
+ * `pools` zones leaves neighbouring zones in the same pool whenever Nx or Ny
+ * is 1 (any prime number of pools), so zones follow a shifted reuse pattern
+ * instead: zone_id = (X + shift * Y) mod pools, with X = floor(x / L) and
+ * Y = floor(y / L). Neighbouring zones never share an id.
+ */
+uint32_t get_zone_id(double x, double y, const sidelink_zone_config& config) {
+    int64_t pools = config.pools;
+    int64_t zx = static_cast<int64_t>(std::floor(x / config.zone_length));
+    int64_t zy = static_cast<int64_t>(std::floor(y / config.zone_length));
+    int64_t id = (zx + get_zone_shift(config.pools) * zy) % pools;
+    return static_cast<uint32_t>((id < 0) ? id + pools : id);
+}
+
+uint16_t get_zone_pool(double x, double y, const sidelink_zone_config& config) {
+    return static_cast<uint16_t>(get_zone_id(x, y, config));
+}
+
+/**
+ * @brief sl-TimeResource bitmap of a pool
+ *
+ * Pools are interleaved in time so they never share a slot: bit k belongs
+ * to pool k mod pools. The bitmap is mapped onto the sidelink slots of the
+ * TDD pattern, so its length is a multiple of lcm(pools, sidelink slots per
+ * pattern), and at least 10 bits.
+ */
+std::vector<std::bitset<1>> create_pool_time_bitmap(uint16_t pool, uint16_t pools,
+    uint16_t sidelink_slots) {
+    size_t period = std::lcm<size_t>(pools, std::max<uint16_t>(sidelink_slots, 1));
+    size_t length = period * ((10 + period - 1) / period);
+    std::vector<std::bitset<1>> bitmap(length);
+    for (size_t k = 0; k < length; k++) {
+        bitmap[k] = (k % pools == pool) ? 1 : 0;
+    }
+    return bitmap;
+}
+
+/**
+ * @brief sidelink slots of a TDD pattern such as "DL|DL|F|UL|UL|"
+ */
+std::vector<bool> get_sidelink_slots(const std::string& pattern) {
+    std::vector<bool> slots;
+    std::stringstream ss(pattern);
+    std::string slot;
+    while (std::getline(ss, slot, '|')) {
+        if (!slot.empty()) slots.push_back(slot == "UL");
+    }
+    return slots;
+}
+
+/**
+ * @brief pool owning a physical slot, from the pool time bitmaps
+ *
+ * The bitmaps are repeated over the sidelink slots of the TDD pattern
+ * (counted from slot 0), and bit k belongs to pool k mod pools.
+ */
+uint16_t get_slot_pool(int64_t slot, const std::vector<bool>& sidelink_slots, uint16_t pools) {
+    if (pools <= 1 || sidelink_slots.empty()) return 0;
+    int64_t period = sidelink_slots.size();
+    int64_t per_period = std::count(sidelink_slots.begin(), sidelink_slots.end(), true);
+    int64_t index = (slot / period) * per_period +
+        std::count(sidelink_slots.begin(), sidelink_slots.begin() + slot % period, true);
+    return static_cast<uint16_t>(index % pools);
+}
+
+/**
+ * @brief per-pool statistics
+ *
+ * @param vehicles vehicles currently assigned to the pool
+ * @param reassignments vehicles that moved into the pool
+ * @param transmissions PSCCH/PSSCH transmissions
+ * @param occupied subchannel-slots used, counted per transmitting vehicle
+ * @param collided of those, subchannel-slots also used by another vehicle
+ * within collision_range
+ */
+struct pool_stats {
+    uint32_t vehicles = 0;
+    uint64_t reassignments = 0;
+    uint64_t transmissions = 0;
+    uint64_t occupied = 0;
+    uint64_t collided = 0;
+};
+
+/**
+ * @brief vehicle using a subchannel in the current slot
+ */
+struct subchannel_user {
+    uint64_t transmitter = 0;
+    double x = 0.0;
+    double y = 0.0;
+    uint16_t pool = 0;
+    bool collided = false;
+};
+
+/**
+ * @brief collision accounting of the current slot
+ *
+ * Transmissions are reported slot by slot in time order, so only the
+ * subchannels of the current slot are kept. Occupancy is physical: a vehicle
+ * still transmitting on a semi-persistent grant of its previous pool collides
+ * with the vehicles of that slot.
+ */
+struct slot_occupancy {
+    int64_t slot = -1;
+    std::unordered_map<uint16_t, std::vector<subchannel_user>> subchannels;
+};
+
+/**
+ * @brief accounts one PSSCH transmission
+ *
+ * Both vehicles of a subchannel-slot collide when they are within range;
+ * farther apart they are the intended spatial reuse of the pool.
+ *
+ * @param pool pool owning the slot, see get_slot_pool()
+ * @param x position of the transmitter
+ * @param y position of the transmitter
+ * @param range collision range (m)
+ */
+void update_pool_stats(std::vector<pool_stats>& stats, slot_occupancy& occupancy,
+    uint16_t pool, int64_t slot, uint64_t transmitter, double x, double y, double range,
+    uint16_t subchannel_start, uint16_t subchannel_length) {
+    if (slot != occupancy.slot) {
+        occupancy.slot = slot;
+        occupancy.subchannels.clear();
+    }
+    pool_stats& s = stats[pool];
+    s.transmissions++;
+    for (uint16_t sc = subchannel_start; sc < subchannel_start + subchannel_length; sc++) {
+        std::vector<subchannel_user>& users = occupancy.subchannels[sc];
+        bool reported = std::any_of(users.begin(), users.end(),
+            [transmitter](const subchannel_user& u) { return u.transmitter == transmitter; });
+        if (reported) continue;
+        subchannel_user user{transmitter, x, y, pool, false};
+        for (subchannel_user& other : users) {
+            if (std::hypot(other.x - x, other.y - y) > range) continue;
+            if (!other.collided) {
+                other.collided = true;
+                stats[other.pool].collided++;
+            }
+            user.collided = true;
+        }
+        s.occupied++;
+        if (user.collided) s.collided++;
+        users.push_back(user);
+    }
+}
+
+std::string get_pool_stats_str(const std::vector<pool_stats>& stats, double duration) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (size_t p = 0; p < stats.size(); p++) {
+        const pool_stats& s = stats[p];
+        ss << "Pool " << p << ": vehicles " << s.vehicles
+           << ", reassignments " << s.reassignments
+           << ", transmissions " << s.transmissions
+           << ", occupied subchannel-slots/s " << ((duration > 0.0) ? s.occupied / duration : 0.0)
+           << ", collision ratio " << ((s.occupied > 0) ? static_cast<double>(s.collided) / s.occupied : 0.0)
+           << "\n";
+    }
+    return ss.str();
+}
+
+#endif
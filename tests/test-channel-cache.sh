@@ -0,0 +1,59 @@
+#!/bin/sh
+# Record/replay test of the channel cache:
+#  - a run that records the channels and a run that replays them with the
+#    same arguments must produce the same output;
+#  - a replay with different traffic (more groupcast transmitters, so the
+#    channels are requested at other times) must complete and replay.
+#
+# Usage (from the NS-3 source directory, script in scratch/):
+#   sh /path/to/tests/test-channel-cache.sh [extra cttc-nr-v2x-mec arguments]
+set -e
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    name=$1
+    shift
+    if ! ./ns3 run --no-build "scratch/cttc-nr-v2x-mec --channelCache=true \
+        --channelCacheDir=$work/cache --outputDir=$work/$name $*" > "$work/$name.log" 2>&1; then
+        echo "FAIL: $name run failed, see below"
+        tail -n 20 "$work/$name.log"
+        exit 1
+    fi
+    # only the cache lines and the output directory may differ
+    grep -v "^Channel cache" "$work/$name.log" | sed "s|$work/$name|OUT|g" > "$work/$name.out"
+}
+
+# prints the replayed count of the cache statistics line of a run
+replayed() {
+    sed -n 's/^Channel cache (replay): \([0-9]*\) replayed.*/\1/p' "$work/$1.log" | head -n 1
+}
+
+run record "$@"
+if ! ls "$work/cache"/channel-*.bin > /dev/null 2>&1; then
+    echo "FAIL: no channel cache was recorded"
+    exit 1
+fi
+
+run replay "$@"
+if [ "$(replayed replay)" -gt 0 ] 2> /dev/null; then :; else
+    echo "FAIL: second run did not replay the channel cache"
+    exit 1
+fi
+if ! diff "$work/record.out" "$work/replay.out" || \
+   ! diff "$work/record/metrics-run-1.txt" "$work/replay/metrics-run-1.txt"; then
+    echo "FAIL: replayed run differs from the recorded run"
+    exit 1
+fi
+
+run sweep "$@" --slTransmitters=2
+if [ "$(replayed sweep)" -gt 0 ] 2> /dev/null; then :; else
+    echo "FAIL: run with different traffic did not replay the channel cache"
+    exit 1
+fi
+if [ ! -s "$work/sweep/metrics-run-1.txt" ]; then
+    echo "FAIL: run with different traffic wrote no metrics"
+    exit 1
+fi
+echo "PASS: replayed run matches the recorded run, sweep run replayed $(replayed sweep) channels"